@@ -0,0 +1,1030 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Analisador offline dos arquivos gerados pelas simulacoes
+//
+//  ./waf --run "analisador --intervalo=0.1 --saida=resultados.col
+//               rede1-0-0.pcap LAN-0-0.pcap redeC-0-0.pcap flowRedeC.xml"
+//
+//  .pcap  -> series temporais por fluxo (vazao, RTT, perdas)
+//  .xml   -> resumo por fluxo do FlowMonitor
+//
+//  Pedidos UDP e segmentos TCP sem resposta ha mais de --espera segundos
+//  (padrao 1, o intervalo dos clientes echo e o RTO minimo do TCP) deixam
+//  de ser acompanhados; o pedido UDP conta como perda se o fluxo for do
+//  tipo echo. Assim a memoria nao cresce com o tamanho de capturas de um
+//  sentido so, e uma resposta nao e casada com um pedido ja perdido.
+//
+//  Os arquivos sao mapeados em memoria (mmap) e processados em paralelo,
+//  um arquivo por thread. O XML e lido em uma unica passada, sem montar
+//  a arvore do documento.
+//
+//  Saida colunar (little-endian):
+//  "NSTCOL1\0" | u32 nTabelas | por tabela: nome, u64 nLinhas, u32 nColunas
+//  | por coluna: nome, u8 tipo, dados contiguos
+//  Nomes e strings: u16 tamanho + bytes
+
+namespace {
+
+enum TipoColuna
+{
+  COL_U16 = 1,
+  COL_U32 = 2,
+  COL_U64 = 3,
+  COL_F32 = 4,
+  COL_F64 = 5,
+  COL_STR = 6
+};
+
+//Chave de um fluxo (5-tupla)
+struct ChaveFluxo
+{
+  uint32_t origem;
+  uint32_t destino;
+  uint16_t portaOrigem;
+  uint16_t portaDestino;
+  uint8_t protocolo;
+
+  ChaveFluxo Inversa (void) const
+  {
+    ChaveFluxo c = { destino, origem, portaDestino, portaOrigem, protocolo };
+    return c;
+  }
+  bool operator< (const ChaveFluxo &o) const
+  {
+    if (origem != o.origem) return origem < o.origem;
+    if (destino != o.destino) return destino < o.destino;
+    if (portaOrigem != o.portaOrigem) return portaOrigem < o.portaOrigem;
+    if (portaDestino != o.portaDestino) return portaDestino < o.portaDestino;
+    return protocolo < o.protocolo;
+  }
+};
+
+//Acumuladores de um intervalo da serie temporal
+struct Intervalo
+{
+  uint64_t bytes = 0;
+  uint32_t pacotes = 0;
+  uint32_t perdas = 0;
+  uint32_t amostrasRtt = 0;
+  double somaRtt = 0;
+};
+
+//Segmento TCP aguardando ACK
+struct Envio
+{
+  uint64_t instante;
+  bool retransmitido;
+};
+
+struct Fluxo
+{
+  uint32_t id = 0;
+  uint64_t bytes = 0;
+  uint32_t pacotes = 0;
+  std::vector<Intervalo> serie;
+
+  //TCP: segmentos aguardando ACK (fim relativo do segmento -> envio)
+  bool temIsn = false;
+  uint32_t isn = 0;
+  uint64_t ultimoSeq = 0;
+  uint64_t maiorFim = 0;
+  std::map<uint64_t, Envio> pendentes;
+
+  //UDP: pedidos aguardando resposta (tamanho, instante)
+  std::deque<std::pair<uint16_t, uint64_t> > pedidos;
+  bool teveResposta = false;
+};
+
+//Resumo de um fluxo do FlowMonitor
+struct FluxoFlowMon
+{
+  uint32_t id = 0;
+  uint32_t origem = 0;
+  uint32_t destino = 0;
+  uint16_t protocolo = 0;
+  uint16_t portaOrigem = 0;
+  uint16_t portaDestino = 0;
+  double primeiroTx = 0, primeiroRx = 0, ultimoTx = 0, ultimoRx = 0;
+  double somaAtraso = 0, somaJitter = 0;
+  uint64_t txBytes = 0, rxBytes = 0, txPacotes = 0, rxPacotes = 0, perdidos = 0;
+};
+
+struct Resultado
+{
+  std::string nome;
+  std::string erro;
+  std::map<ChaveFluxo, Fluxo> fluxos;
+  std::map<uint32_t, FluxoFlowMon> flowmon;
+};
+
+//Arquivo mapeado somente para leitura
+class ArquivoMapeado
+{
+public:
+  explicit ArquivoMapeado (const std::string &nome)
+  {
+    int fd = open (nome.c_str (), O_RDONLY);
+    if (fd < 0)
+      {
+        return;
+      }
+    struct stat st;
+    if (fstat (fd, &st) == 0 && st.st_size > 0)
+      {
+        void *p = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+          {
+            madvise (p, st.st_size, MADV_SEQUENTIAL);
+            m_dados = static_cast<const uint8_t *> (p);
+            m_tamanho = st.st_size;
+          }
+      }
+    close (fd);
+  }
+  ~ArquivoMapeado ()
+  {
+    if (m_dados)
+      {
+        munmap (const_cast<uint8_t *> (m_dados), m_tamanho);
+      }
+  }
+  const uint8_t *Dados (void) const { return m_dados; }
+  size_t Tamanho (void) const { return m_tamanho; }
+
+private:
+  ArquivoMapeado (const ArquivoMapeado &);
+  ArquivoMapeado &operator= (const ArquivoMapeado &);
+
+  const uint8_t *m_dados = 0;
+  size_t m_tamanho = 0;
+};
+
+uint16_t
+Le16 (const uint8_t *p)
+{
+  return (p[0] << 8) | p[1];
+}
+
+uint32_t
+Le32 (const uint8_t *p)
+{
+  return (uint32_t (p[0]) << 24) | (uint32_t (p[1]) << 16) | (uint32_t (p[2]) << 8) | p[3];
+}
+
+uint32_t
+LeCabecalho32 (const uint8_t *p, bool trocado)
+{
+  uint32_t v;
+  std::memcpy (&v, p, 4);
+  return trocado ? __builtin_bswap32 (v) : v;
+}
+
+std::string
+Ip (uint32_t a)
+{
+  char s[16];
+  std::snprintf (s, sizeof (s), "%u.%u.%u.%u", a >> 24, (a >> 16) & 0xff, (a >> 8) & 0xff, a & 0xff);
+  return s;
+}
+
+//Retorna o inicio do datagrama IPv4 dentro do quadro, ou 0. Em 802.11,
+//vistos guarda o ultimo numero de sequencia por transmissor e TID, para
+//descartar as retentativas da MAC de um quadro ja capturado
+const uint8_t *
+DesencapsulaIpv4 (uint32_t enlace, const uint8_t *p, uint32_t tam, uint32_t *resto,
+                  std::map<uint64_t, uint16_t> &vistos)
+{
+  uint32_t off = 0;
+  switch (enlace)
+    {
+    case 1: //Ethernet (csma)
+      {
+        if (tam < 14) return 0;
+        uint16_t tipo = Le16 (p + 12);
+        off = 14;
+        if (tipo == 0x8100 && tam >= 18)
+          {
+            tipo = Le16 (p + 16);
+            off = 18;
+          }
+        if (tipo != 0x0800) return 0;
+        break;
+      }
+    case 9: //PPP (point-to-point)
+      if (tam < 2 || Le16 (p) != 0x0021) return 0;
+      off = 2;
+      break;
+    case 101: //IP puro
+    case 228:
+      break;
+    case 127: //Radiotap + 802.11
+      {
+        if (tam < 4) return 0;
+        uint32_t rt = p[2] | (p[3] << 8);
+        if (rt > tam) return 0;
+        p += rt;
+        tam -= rt;
+      }
+      //fallthrough
+    case 105: //802.11 (wifi)
+      {
+        if (tam < 24 || ((p[0] >> 2) & 0x3) != 2) return 0;
+        off = 24;
+        if ((p[1] & 0x3) == 0x3) off += 6; //ToDS e FromDS
+        uint64_t chave = 0;
+        for (int i = 10; i < 16; ++i) //Endereco do transmissor
+          {
+            chave = (chave << 8) | p[i];
+          }
+        chave <<= 4;
+        if (p[0] & 0x80) //QoS
+          {
+            if (tam < off + 2) return 0;
+            chave |= p[off] & 0xf;
+            off += 2;
+          }
+        uint16_t numero = (p[22] | (p[23] << 8)) >> 4;
+        std::map<uint64_t, uint16_t>::iterator v = vistos.find (chave);
+        bool repetido = (p[1] & 0x08) && v != vistos.end () && v->second == numero;
+        vistos[chave] = numero;
+        if (repetido) return 0;
+        if (tam < off + 8 || p[off] != 0xaa || p[off + 1] != 0xaa || Le16 (p + off + 6) != 0x0800) return 0;
+        off += 8;
+        break;
+      }
+    default:
+      return 0;
+    }
+  if (tam < off + 20 || (p[off] >> 4) != 4) return 0;
+  *resto = tam - off;
+  return p + off;
+}
+
+//Instantes e intervalos sao inteiros em ns, para que um pacote exatamente na
+//borda de um intervalo (ex.: 2.3 s com intervalos de 0.1 s) caia no intervalo
+//que comeca nela
+class Analisador
+{
+public:
+  Analisador (uint64_t intervalo, uint64_t espera) : m_intervalo (intervalo), m_espera (espera) {}
+
+  void Pcap (const uint8_t *d, size_t tam, Resultado &r) const;
+  void FlowMon (const uint8_t *d, size_t tam, Resultado &r) const;
+
+private:
+  Intervalo &Bin (Fluxo &f, uint64_t t) const
+  {
+    size_t i = t / m_intervalo;
+    if (f.serie.size () <= i)
+      {
+        f.serie.resize (i + 1);
+      }
+    return f.serie[i];
+  }
+  Fluxo &Obtem (Resultado &r, const ChaveFluxo &c) const
+  {
+    std::map<ChaveFluxo, Fluxo>::iterator it = r.fluxos.find (c);
+    if (it == r.fluxos.end ())
+      {
+        it = r.fluxos.insert (std::make_pair (c, Fluxo ())).first;
+        it->second.id = r.fluxos.size () - 1;
+      }
+    return it->second;
+  }
+  void Tcp (Resultado &r, const ChaveFluxo &c, Fluxo &f, const uint8_t *tcp,
+            uint32_t dados, uint64_t t) const;
+  void Udp (Resultado &r, const ChaveFluxo &c, Fluxo &f, uint16_t dados, uint64_t t) const;
+
+  uint64_t m_intervalo;
+  uint64_t m_espera;
+};
+
+//Estende um numero de sequencia relativo de 32 bits para 64 bits, escolhendo
+//a volta do contador mais proxima da referencia (ultimo valor visto)
+uint64_t
+Desdobra (uint64_t referencia, uint32_t relativo)
+{
+  const uint64_t volta = uint64_t (1) << 32;
+  uint64_t v = (referencia & ~(volta - 1)) | relativo;
+  if (v + volta / 2 < referencia)
+    {
+      v += volta;
+    }
+  else if (v > referencia + volta / 2 && v >= volta)
+    {
+      v -= volta;
+    }
+  return v;
+}
+
+void
+Analisador::Tcp (Resultado &r, const ChaveFluxo &c, Fluxo &f, const uint8_t *tcp,
+                 uint32_t dados, uint64_t t) const
+{
+  uint32_t seq = Le32 (tcp + 4);
+  uint32_t ack = Le32 (tcp + 8);
+  uint8_t flags = tcp[13];
+
+  if (!f.temIsn)
+    {
+      f.temIsn = true;
+      f.isn = seq;
+    }
+  uint64_t inicio = Desdobra (f.ultimoSeq, seq - f.isn);
+  if (inicio > f.ultimoSeq)
+    {
+      f.ultimoSeq = inicio;
+    }
+  uint64_t fim = inicio + dados;
+  if (dados > 0)
+    {
+      if (fim <= f.maiorFim)
+        {
+          //Retransmissao: conta como perda e marca os segmentos que ela cobre;
+          //um ACK que confirme algum deles nao gera amostra de RTT (Karn)
+          Bin (f, t).perdas++;
+          std::map<uint64_t, Envio>::iterator it = f.pendentes.upper_bound (inicio);
+          for (; it != f.pendentes.end (); ++it)
+            {
+              it->second.retransmitido = true;
+              if (it->first >= fim)
+                {
+                  break;
+                }
+            }
+        }
+      else
+        {
+          //Sem ACKs na captura os segmentos mais antigos (primeiros do mapa) expiram
+          while (!f.pendentes.empty () && f.pendentes.begin ()->second.instante + m_espera < t)
+            {
+              f.pendentes.erase (f.pendentes.begin ());
+            }
+          Envio e = { t, false };
+          f.pendentes[fim] = e;
+          f.maiorFim = fim;
+        }
+    }
+
+  //ACK confirma segmentos do fluxo inverso
+  if (flags & 0x10)
+    {
+      std::map<ChaveFluxo, Fluxo>::iterator inv = r.fluxos.find (c.Inversa ());
+      if (inv == r.fluxos.end () || !inv->second.temIsn || inv->second.pendentes.empty ())
+        {
+          return;
+        }
+      Fluxo &o = inv->second;
+      uint64_t confirmado = Desdobra (o.maiorFim, ack - o.isn);
+      std::map<uint64_t, Envio>::iterator lim = o.pendentes.upper_bound (confirmado);
+      if (lim != o.pendentes.begin ())
+        {
+          //Amostra com o segmento mais novo confirmado, so se nenhum byte
+          //confirmado foi retransmitido
+          bool ambiguo = false;
+          for (std::map<uint64_t, Envio>::iterator it = o.pendentes.begin (); it != lim; ++it)
+            {
+              ambiguo = ambiguo || it->second.retransmitido;
+            }
+          std::map<uint64_t, Envio>::iterator ultimo = lim;
+          --ultimo;
+          if (!ambiguo)
+            {
+              Intervalo &b = Bin (o, ultimo->second.instante);
+              b.somaRtt += (t - ultimo->second.instante) * 1e-9;
+              b.amostrasRtt++;
+            }
+          o.pendentes.erase (o.pendentes.begin (), lim);
+        }
+    }
+}
+
+void
+Analisador::Udp (Resultado &r, const ChaveFluxo &c, Fluxo &f, uint16_t dados, uint64_t t) const
+{
+  //Resposta do tipo echo: casa com o pedido mais antigo de mesmo tamanho
+  std::map<ChaveFluxo, Fluxo>::iterator inv = r.fluxos.find (c.Inversa ());
+  if (inv != r.fluxos.end () && !inv->second.pedidos.empty ())
+    {
+      Fluxo &o = inv->second;
+      while (!o.pedidos.empty ())
+        {
+          std::pair<uint16_t, uint64_t> p = o.pedidos.front ();
+          o.pedidos.pop_front ();
+          if (p.first == dados && p.second + m_espera >= t)
+            {
+              Intervalo &b = Bin (o, p.second);
+              b.somaRtt += (t - p.second) * 1e-9;
+              b.amostrasRtt++;
+              o.teveResposta = true;
+              return;
+            }
+          Bin (o, p.second).perdas++;
+        }
+      return;
+    }
+  bool echo = f.teveResposta || inv != r.fluxos.end ();
+  while (!f.pedidos.empty () && f.pedidos.front ().second + m_espera < t)
+    {
+      if (echo)
+        {
+          Bin (f, f.pedidos.front ().second).perdas++;
+        }
+      f.pedidos.pop_front ();
+    }
+  f.pedidos.push_back (std::make_pair (dados, t));
+}
+
+void
+Analisador::Pcap (const uint8_t *d, size_t tam, Resultado &r) const
+{
+  if (tam < 24)
+    {
+      r.erro = "arquivo pcap truncado";
+      return;
+    }
+  uint32_t magico;
+  std::memcpy (&magico, d, 4);
+  bool trocado = false;
+  uint32_t escala = 1000; //fracao em us ou em ns
+  switch (magico)
+    {
+    case 0xa1b2c3d4: break;
+    case 0xa1b23c4d: escala = 1; break;
+    case 0xd4c3b2a1: trocado = true; break;
+    case 0x4d3cb2a1: trocado = true; escala = 1; break;
+    default:
+      r.erro = "formato pcap desconhecido";
+      return;
+    }
+  uint32_t enlace = LeCabecalho32 (d + 20, trocado);
+
+  std::map<uint64_t, uint16_t> vistos;
+  bool temOrigem = false;
+  uint64_t origem = 0;
+  size_t off = 24;
+  while (off + 16 <= tam)
+    {
+      uint32_t seg = LeCabecalho32 (d + off, trocado);
+      uint32_t frac = LeCabecalho32 (d + off + 4, trocado);
+      uint32_t incl = LeCabecalho32 (d + off + 8, trocado);
+      off += 16;
+      if (off + incl > tam)
+        {
+          break;
+        }
+      const uint8_t *quadro = d + off;
+      off += incl;
+
+      //Tempos do ns-3 comecam em zero; capturas reais sao relativas ao primeiro pacote
+      uint64_t t = seg * uint64_t (1000000000) + uint64_t (frac) * escala;
+      if (!temOrigem)
+        {
+          temOrigem = true;
+          origem = seg > 1000000 ? t : 0;
+        }
+      t = t > origem ? t - origem : 0;
+
+      uint32_t resto;
+      const uint8_t *ip = DesencapsulaIpv4 (enlace, quadro, incl, &resto, vistos);
+      if (!ip)
+        {
+          continue;
+        }
+      uint32_t ihl = (ip[0] & 0xf) * 4;
+      uint32_t total = Le16 (ip + 2);
+      ChaveFluxo c = { Le32 (ip + 12), Le32 (ip + 16), 0, 0, ip[9] };
+      bool fragmento = (Le16 (ip + 6) & 0x1fff) != 0;
+      const uint8_t *l4 = ip + ihl;
+      uint32_t l4tam = total > ihl ? total - ihl : 0;
+      bool temL4 = !fragmento && resto >= ihl + 8;
+      if (temL4 && (c.protocolo == 6 || c.protocolo == 17))
+        {
+          c.portaOrigem = Le16 (l4);
+          c.portaDestino = Le16 (l4 + 2);
+        }
+
+      Fluxo &f = Obtem (r, c);
+      f.bytes += total;
+      f.pacotes++;
+      Intervalo &b = Bin (f, t);
+      b.bytes += total;
+      b.pacotes++;
+
+      if (temL4 && c.protocolo == 6 && resto >= ihl + 20)
+        {
+          uint32_t doff = (l4[12] >> 4) * 4;
+          Tcp (r, c, f, l4, l4tam > doff ? l4tam - doff : 0, t);
+        }
+      else if (temL4 && c.protocolo == 17)
+        {
+          Udp (r, c, f, l4tam > 8 ? l4tam - 8 : 0, t);
+        }
+    }
+
+  //Pedidos UDP sem resposta contam como perdas quando o fluxo e do tipo echo
+  for (std::map<ChaveFluxo, Fluxo>::iterator it = r.fluxos.begin (); it != r.fluxos.end (); ++it)
+    {
+      Fluxo &f = it->second;
+      std::map<ChaveFluxo, Fluxo>::iterator inv = r.fluxos.find (it->first.Inversa ());
+      if (f.teveResposta || (inv != r.fluxos.end () && it->first.protocolo == 17))
+        {
+          for (size_t i = 0; i < f.pedidos.size (); ++i)
+            {
+              Bin (f, f.pedidos[i].second).perdas++;
+            }
+        }
+      f.pedidos.clear ();
+      f.pendentes.clear ();
+    }
+}
+
+//Valor numerico de um atributo do FlowMonitor ("+1.5e+09ns", "10.1.1.1", "42")
+double
+Numero (const std::string &v)
+{
+  return std::strtod (v.c_str () + (v[0] == '+' ? 1 : 0), 0);
+}
+
+uint32_t
+Endereco (const std::string &v)
+{
+  unsigned a, b, c, d;
+  if (std::sscanf (v.c_str (), "%u.%u.%u.%u", &a, &b, &c, &d) != 4)
+    {
+      return 0;
+    }
+  return (a << 24) | (b << 16) | (c << 8) | d;
+}
+
+void
+Analisador::FlowMon (const uint8_t *d, size_t tam, Resultado &r) const
+{
+  //Leitura em fluxo: so interessa a pilha de elementos abertos e os atributos de <Flow>
+  const char *p = reinterpret_cast<const char *> (d);
+  const char *fim = p + tam;
+  std::vector<std::string> pilha;
+  std::vector<std::pair<std::string, std::string> > atributos;
+
+  while (p < fim)
+    {
+      p = static_cast<const char *> (std::memchr (p, '<', fim - p));
+      if (!p)
+        {
+          break;
+        }
+      ++p;
+      if (p < fim && (*p == '?' || *p == '!'))
+        {
+          static const char fimComentario[] = "-->";
+          const char *f = (fim - p >= 3 && std::strncmp (p, "!--", 3) == 0)
+            ? std::search (p, fim, fimComentario, fimComentario + 3)
+            : std::find (p, fim, '>');
+          if (f == fim)
+            {
+              break;
+            }
+          p = std::find (f, fim, '>') + 1;
+          continue;
+        }
+      if (p < fim && *p == '/')
+        {
+          if (!pilha.empty ())
+            {
+              pilha.pop_back ();
+            }
+          continue;
+        }
+
+      const char *n = p;
+      while (p < fim && !std::isspace (*p) && *p != '>' && *p != '/')
+        {
+          ++p;
+        }
+      std::string nome (n, p);
+      atributos.clear ();
+      bool vazio = false;
+      while (p < fim && *p != '>')
+        {
+          if (*p == '/')
+            {
+              vazio = true;
+              ++p;
+              continue;
+            }
+          if (std::isspace (*p))
+            {
+              ++p;
+              continue;
+            }
+          const char *a = p;
+          while (p < fim && *p != '=' && !std::isspace (*p) && *p != '>')
+            {
+              ++p;
+            }
+          std::string chave (a, p);
+          while (p < fim && *p != '"' && *p != '\'' && *p != '>')
+            {
+              ++p;
+            }
+          if (p >= fim || *p == '>')
+            {
+              break;
+            }
+          char aspas = *p++;
+          const char *v = p;
+          while (p < fim && *p != aspas)
+            {
+              ++p;
+            }
+          atributos.push_back (std::make_pair (chave, std::string (v, p)));
+          if (p < fim)
+            {
+              ++p;
+            }
+        }
+      ++p;
+
+      if (nome == "Flow" && !pilha.empty ())
+        {
+          const std::string &pai = pilha.back ();
+          uint32_t id = 0;
+          for (size_t i = 0; i < atributos.size (); ++i)
+            {
+              if (atributos[i].first == "flowId")
+                {
+                  id = std::strtoul (atributos[i].second.c_str (), 0, 10);
+                }
+            }
+          FluxoFlowMon &f = r.flowmon[id];
+          f.id = id;
+          for (size_t i = 0; i < atributos.size (); ++i)
+            {
+              const std::string &k = atributos[i].first;
+              const std::string &v = atributos[i].second;
+              if (pai == "FlowStats")
+                {
+                  if (k == "timeFirstTxPacket") f.primeiroTx = Numero (v) * 1e-9;
+                  else if (k == "timeFirstRxPacket") f.primeiroRx = Numero (v) * 1e-9;
+                  else if (k == "timeLastTxPacket") f.ultimoTx = Numero (v) * 1e-9;
+                  else if (k == "timeLastRxPacket") f.ultimoRx = Numero (v) * 1e-9;
+                  else if (k == "delaySum") f.somaAtraso = Numero (v) * 1e-9;
+                  else if (k == "jitterSum") f.somaJitter = Numero (v) * 1e-9;
+                  else if (k == "txBytes") f.txBytes = Numero (v);
+                  else if (k == "rxBytes") f.rxBytes = Numero (v);
+                  else if (k == "txPackets") f.txPacotes = Numero (v);
+                  else if (k == "rxPackets") f.rxPacotes = Numero (v);
+                  else if (k == "lostPackets") f.perdidos = Numero (v);
+                }
+              else if (pai == "Ipv4FlowClassifier")
+                {
+                  if (k == "sourceAddress") f.origem = Endereco (v);
+                  else if (k == "destinationAddress") f.destino = Endereco (v);
+                  else if (k == "protocol") f.protocolo = Numero (v);
+                  else if (k == "sourcePort") f.portaOrigem = Numero (v);
+                  else if (k == "destinationPort") f.portaDestino = Numero (v);
+                }
+            }
+        }
+      if (!vazio)
+        {
+          pilha.push_back (nome);
+        }
+    }
+}
+
+//Tabela colunar acumulada em memoria antes de ser gravada
+class Tabela
+{
+public:
+  explicit Tabela (const std::string &nome) : m_nome (nome), m_linhas (0) {}
+
+  size_t Coluna (const std::string &nome, TipoColuna tipo)
+  {
+    m_colunas.push_back (Col ());
+    m_colunas.back ().nome = nome;
+    m_colunas.back ().tipo = tipo;
+    return m_colunas.size () - 1;
+  }
+  template <typename T>
+  void Poe (size_t col, T v)
+  {
+    std::vector<char> &d = m_colunas[col].dados;
+    d.insert (d.end (), reinterpret_cast<const char *> (&v), reinterpret_cast<const char *> (&v) + sizeof (T));
+  }
+  void PoeTexto (size_t col, const std::string &s)
+  {
+    Poe<uint16_t> (col, s.size ());
+    m_colunas[col].dados.insert (m_colunas[col].dados.end (), s.begin (), s.end ());
+  }
+  void FimLinha (void) { m_linhas++; }
+  void Grava (std::FILE *f) const
+  {
+    GravaTexto (f, m_nome);
+    uint64_t linhas = m_linhas;
+    uint32_t colunas = m_colunas.size ();
+    std::fwrite (&linhas, sizeof (linhas), 1, f);
+    std::fwrite (&colunas, sizeof (colunas), 1, f);
+    for (size_t i = 0; i < m_colunas.size (); ++i)
+      {
+        GravaTexto (f, m_colunas[i].nome);
+        uint8_t tipo = m_colunas[i].tipo;
+        std::fwrite (&tipo, 1, 1, f);
+        std::fwrite (m_colunas[i].dados.data (), 1, m_colunas[i].dados.size (), f);
+      }
+  }
+
+private:
+  struct Col
+  {
+    std::string nome;
+    TipoColuna tipo;
+    std::vector<char> dados;
+  };
+  static void GravaTexto (std::FILE *f, const std::string &s)
+  {
+    uint16_t n = s.size ();
+    std::fwrite (&n, sizeof (n), 1, f);
+    std::fwrite (s.data (), 1, n, f);
+  }
+
+  std::string m_nome;
+  uint64_t m_linhas;
+  std::vector<Col> m_colunas;
+};
+
+bool
+TerminaCom (const std::string &s, const std::string &sufixo)
+{
+  return s.size () >= sufixo.size () && s.compare (s.size () - sufixo.size (), sufixo.size (), sufixo) == 0;
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  double intervalo = 0.1;
+  double espera = 1.0;
+  std::string saida = "resultados.col";
+  unsigned threads = std::thread::hardware_concurrency ();
+  std::vector<std::string> arquivos;
+
+  for (int i = 1; i < argc; ++i)
+    {
+      std::string a = argv[i];
+      if (a.compare (0, 12, "--intervalo=") == 0)
+        {
+          intervalo = std::atof (a.c_str () + 12);
+        }
+      else if (a.compare (0, 9, "--espera=") == 0)
+        {
+          espera = std::atof (a.c_str () + 9);
+        }
+      else if (a.compare (0, 8, "--saida=") == 0)
+        {
+          saida = a.substr (8);
+        }
+      else if (a.compare (0, 10, "--threads=") == 0)
+        {
+          threads = std::atoi (a.c_str () + 10);
+        }
+      else if (a.compare (0, 2, "--") == 0)
+        {
+          std::cerr << "uso: analisador [--intervalo=s] [--espera=s] [--saida=arquivo] [--threads=n] "
+                    << "arquivo.pcap|arquivo.xml ..." << std::endl;
+          return 1;
+        }
+      else
+        {
+          arquivos.push_back (a);
+        }
+    }
+  if (arquivos.empty () || std::llround (intervalo * 1e9) <= 0 || espera < 0)
+    {
+      std::cerr << "uso: analisador [--intervalo=s] [--espera=s] [--saida=arquivo] [--threads=n] "
+                << "arquivo.pcap|arquivo.xml ..." << std::endl;
+      return 1;
+    }
+  if (threads == 0)
+    {
+      threads = 1;
+    }
+  if (threads > arquivos.size ())
+    {
+      threads = arquivos.size ();
+    }
+
+  //Processa os arquivos em paralelo, um por vez em cada thread
+  Analisador analisador (std::llround (intervalo * 1e9), std::llround (espera * 1e9));
+  std::vector<Resultado> resultados (arquivos.size ());
+  std::atomic<size_t> proximo (0);
+  std::vector<std::thread> trabalhadores;
+  for (unsigned t = 0; t < threads; ++t)
+    {
+      trabalhadores.push_back (std::thread ([&] () {
+        for (size_t i = proximo++; i < arquivos.size (); i = proximo++)
+          {
+            Resultado &r = resultados[i];
+            r.nome = arquivos[i];
+            ArquivoMapeado m (arquivos[i]);
+            if (!m.Dados ())
+              {
+                r.erro = "nao foi possivel abrir";
+              }
+            else if (TerminaCom (arquivos[i], ".xml"))
+              {
+                analisador.FlowMon (m.Dados (), m.Tamanho (), r);
+              }
+            else
+              {
+                analisador.Pcap (m.Dados (), m.Tamanho (), r);
+              }
+          }
+      }));
+    }
+  for (size_t t = 0; t < trabalhadores.size (); ++t)
+    {
+      trabalhadores[t].join ();
+    }
+
+  //Monta as tabelas de saida
+  Tabela tArquivos ("arquivos");
+  size_t aId = tArquivos.Coluna ("arquivo", COL_U32);
+  size_t aNome = tArquivos.Coluna ("nome", COL_STR);
+
+  Tabela tFluxos ("fluxos");
+  size_t fArq = tFluxos.Coluna ("arquivo", COL_U32);
+  size_t fId = tFluxos.Coluna ("fluxo", COL_U32);
+  size_t fOrig = tFluxos.Coluna ("origem", COL_U32);
+  size_t fDest = tFluxos.Coluna ("destino", COL_U32);
+  size_t fProto = tFluxos.Coluna ("protocolo", COL_U16);
+  size_t fPo = tFluxos.Coluna ("portaOrigem", COL_U16);
+  size_t fPd = tFluxos.Coluna ("portaDestino", COL_U16);
+  size_t fPac = tFluxos.Coluna ("pacotes", COL_U32);
+  size_t fBytes = tFluxos.Coluna ("bytes", COL_U64);
+
+  Tabela tSeries ("series");
+  size_t sArq = tSeries.Coluna ("arquivo", COL_U32);
+  size_t sFluxo = tSeries.Coluna ("fluxo", COL_U32);
+  size_t sInicio = tSeries.Coluna ("inicio", COL_F32);
+  size_t sVazao = tSeries.Coluna ("vazao", COL_F32);
+  size_t sPac = tSeries.Coluna ("pacotes", COL_U32);
+  size_t sRtt = tSeries.Coluna ("rtt", COL_F32);
+  size_t sAmostras = tSeries.Coluna ("amostrasRtt", COL_U32);
+  size_t sPerdas = tSeries.Coluna ("perdas", COL_U32);
+
+  Tabela tFlowMon ("flowmon");
+  size_t mArq = tFlowMon.Coluna ("arquivo", COL_U32);
+  size_t mId = tFlowMon.Coluna ("fluxo", COL_U32);
+  size_t mOrig = tFlowMon.Coluna ("origem", COL_U32);
+  size_t mDest = tFlowMon.Coluna ("destino", COL_U32);
+  size_t mProto = tFlowMon.Coluna ("protocolo", COL_U16);
+  size_t mPo = tFlowMon.Coluna ("portaOrigem", COL_U16);
+  size_t mPd = tFlowMon.Coluna ("portaDestino", COL_U16);
+  size_t mTxP = tFlowMon.Coluna ("txPacotes", COL_U64);
+  size_t mRxP = tFlowMon.Coluna ("rxPacotes", COL_U64);
+  size_t mPerd = tFlowMon.Coluna ("perdidos", COL_U64);
+  size_t mTxB = tFlowMon.Coluna ("txBytes", COL_U64);
+  size_t mRxB = tFlowMon.Coluna ("rxBytes", COL_U64);
+  size_t mVazao = tFlowMon.Coluna ("vazao", COL_F64);
+  size_t mAtraso = tFlowMon.Coluna ("atrasoMedio", COL_F64);
+  size_t mJitter = tFlowMon.Coluna ("jitterMedio", COL_F64);
+  size_t mTaxa = tFlowMon.Coluna ("taxaPerda", COL_F64);
+
+  int falhas = 0;
+  for (uint32_t a = 0; a < resultados.size (); ++a)
+    {
+      const Resultado &r = resultados[a];
+      tArquivos.Poe<uint32_t> (aId, a);
+      tArquivos.PoeTexto (aNome, r.nome);
+      tArquivos.FimLinha ();
+      if (!r.erro.empty ())
+        {
+          std::cerr << r.nome << ": " << r.erro << std::endl;
+          falhas++;
+          continue;
+        }
+
+      for (std::map<ChaveFluxo, Fluxo>::const_iterator it = r.fluxos.begin (); it != r.fluxos.end (); ++it)
+        {
+          const ChaveFluxo &c = it->first;
+          const Fluxo &f = it->second;
+          tFluxos.Poe<uint32_t> (fArq, a);
+          tFluxos.Poe<uint32_t> (fId, f.id);
+          tFluxos.Poe<uint32_t> (fOrig, c.origem);
+          tFluxos.Poe<uint32_t> (fDest, c.destino);
+          tFluxos.Poe<uint16_t> (fProto, c.protocolo);
+          tFluxos.Poe<uint16_t> (fPo, c.portaOrigem);
+          tFluxos.Poe<uint16_t> (fPd, c.portaDestino);
+          tFluxos.Poe<uint32_t> (fPac, f.pacotes);
+          tFluxos.Poe<uint64_t> (fBytes, f.bytes);
+          tFluxos.FimLinha ();
+
+          //So os intervalos com atividade, para manter o arquivo compacto
+          for (size_t i = 0; i < f.serie.size (); ++i)
+            {
+              const Intervalo &b = f.serie[i];
+              if (b.pacotes == 0 && b.amostrasRtt == 0 && b.perdas == 0)
+                {
+                  continue;
+                }
+              tSeries.Poe<uint32_t> (sArq, a);
+              tSeries.Poe<uint32_t> (sFluxo, f.id);
+              tSeries.Poe<float> (sInicio, i * intervalo);
+              tSeries.Poe<float> (sVazao, b.bytes * 8.0 / intervalo);
+              tSeries.Poe<uint32_t> (sPac, b.pacotes);
+              tSeries.Poe<float> (sRtt, b.amostrasRtt ? b.somaRtt / b.amostrasRtt * 1e3 : NAN);
+              tSeries.Poe<uint32_t> (sAmostras, b.amostrasRtt);
+              tSeries.Poe<uint32_t> (sPerdas, b.perdas);
+              tSeries.FimLinha ();
+            }
+          std::cout << r.nome << " fluxo " << f.id << " " << Ip (c.origem) << ":" << c.portaOrigem
+                    << " -> " << Ip (c.destino) << ":" << c.portaDestino
+                    << " (" << unsigned (c.protocolo) << ") " << f.pacotes << " pacotes, "
+                    << f.bytes << " bytes" << std::endl;
+        }
+
+      for (std::map<uint32_t, FluxoFlowMon>::const_iterator it = r.flowmon.begin (); it != r.flowmon.end (); ++it)
+        {
+          const FluxoFlowMon &f = it->second;
+          double duracao = f.ultimoRx - f.primeiroRx;
+          double vazao = duracao > 0 ? f.rxBytes * 8.0 / duracao : 0;
+          double atraso = f.rxPacotes ? f.somaAtraso / f.rxPacotes * 1e3 : NAN;
+          double jitter = f.rxPacotes > 1 ? f.somaJitter / (f.rxPacotes - 1) * 1e3 : NAN;
+          double taxa = f.txPacotes ? double (f.perdidos) / f.txPacotes : 0;
+          tFlowMon.Poe<uint32_t> (mArq, a);
+          tFlowMon.Poe<uint32_t> (mId, f.id);
+          tFlowMon.Poe<uint32_t> (mOrig, f.origem);
+          tFlowMon.Poe<uint32_t> (mDest, f.destino);
+          tFlowMon.Poe<uint16_t> (mProto, f.protocolo);
+          tFlowMon.Poe<uint16_t> (mPo, f.portaOrigem);
+          tFlowMon.Poe<uint16_t> (mPd, f.portaDestino);
+          tFlowMon.Poe<uint64_t> (mTxP, f.txPacotes);
+          tFlowMon.Poe<uint64_t> (mRxP, f.rxPacotes);
+          tFlowMon.Poe<uint64_t> (mPerd, f.perdidos);
+          tFlowMon.Poe<uint64_t> (mTxB, f.txBytes);
+          tFlowMon.Poe<uint64_t> (mRxB, f.rxBytes);
+          tFlowMon.Poe<double> (mVazao, vazao);
+          tFlowMon.Poe<double> (mAtraso, atraso);
+          tFlowMon.Poe<double> (mJitter, jitter);
+          tFlowMon.Poe<double> (mTaxa, taxa);
+          tFlowMon.FimLinha ();
+          std::cout << r.nome << " fluxo " << f.id << " " << Ip (f.origem) << ":" << f.portaOrigem
+                    << " -> " << Ip (f.destino) << ":" << f.portaDestino
+                    << " vazao " << vazao / 1e3 << " kbps, atraso " << atraso
+                    << " ms, perda " << taxa * 100 << "%" << std::endl;
+        }
+    }
+
+  std::FILE *f = std::fopen (saida.c_str (), "wb");
+  if (!f)
+    {
+      std::cerr << "nao foi possivel gravar " << saida << std::endl;
+      return 1;
+    }
+  std::fwrite ("NSTCOL1", 1, 8, f);
+  uint32_t nTabelas = 4;
+  std::fwrite (&nTabelas, sizeof (nTabelas), 1, f);
+  tArquivos.Grava (f);
+  tFluxos.Grava (f);
+  tSeries.Grava (f);
+  tFlowMon.Grava (f);
+  std::fclose (f);
+
+  return falhas ? 1 : 0;
+}
@@ -0,0 +1,95 @@
+#!/bin/sh
+# Compara o redeD com e sem o pool de objetos (pool.h)
+#
+#  Rodar a partir da raiz do ns-3, de preferencia com build otimizado:
+#  ./waf configure --build-profile=optimized && ./waf build
+#  sh scratch/benchPool.sh [duracao] [repeticoes]
+#
+#  sh scratch/benchPool.sh micro [repeticoes]
+#  roda so o alocador, sem o ns-3, com o padrao de alocacao de um segmento
+#  (Packet, Buffer::Data, metadados, tags, evento) e fila FIFO de pacotes
+
+DIR=$(dirname "$0")
+
+if [ "$1" = micro ]; then
+  REPETICOES=${2:-3}
+  TMP=$(mktemp -d)
+  cat > "$TMP/micro.cc" <<'FIM'
+#include "pool.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+
+struct Segmento
+{
+  void *p[6];
+};
+
+int
+main (int argc, char *argv[])
+{
+  bool usaPool = argc > 1 && argv[1][0] == '1';
+  std::size_t buffer = argc > 2 ? std::atoi (argv[2]) : 1600;
+  std::size_t tam[6] = { 72, buffer, 96, 64, 48, 120 };
+  if (usaPool)
+    {
+      pool::Ativa ();
+    }
+  std::deque<Segmento> fila;
+  unsigned s = 1;
+  std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now ();
+  for (long i = 0; i < 20000000; ++i)
+    {
+      Segmento g;
+      for (int k = 0; k < 6; ++k)
+        {
+          g.p[k] = ::operator new (tam[k]);
+          *static_cast<char *> (g.p[k]) = k;
+        }
+      fila.push_back (g);
+      s = s * 1103515245 + 12345;
+      std::size_t alvo = 100 + (s >> 16) % 200;
+      while (fila.size () > alvo)
+        {
+          for (int k = 0; k < 6; ++k)
+            {
+              ::operator delete (fila.front ().p[k]);
+            }
+          fila.pop_front ();
+        }
+    }
+  double segundos = std::chrono::duration<double> (std::chrono::steady_clock::now () - inicio).count ();
+  pool::Contadores c = pool::Estatisticas ();
+  std::printf ("pool=%s buffer=%lu tempo=%.3fs alocacoes=%lu malloc=%lu\n", usaPool ? "true" : "false",
+               (unsigned long) buffer, segundos, (unsigned long) c.alocacoes, (unsigned long) c.malloc);
+  return 0;
+}
+FIM
+  c++ -std=c++11 -O2 -I"$DIR" "$TMP/micro.cc" -o "$TMP/micro" || exit 1
+  for BUFFER in 1600 40; do
+    for POOL in 0 1; do
+      for i in $(seq "$REPETICOES"); do
+        "$TMP/micro" $POOL $BUFFER
+      done
+    done
+  done
+  rm -rf "$TMP"
+  exit 0
+fi
+
+DURACAO=${1:-60}
+REPETICOES=${2:-3}
+
+for POOL in false true; do
+  for i in $(seq "$REPETICOES"); do
+    ./waf --run "redeD --pool=$POOL --rastros=false --duracao=$DURACAO" 2>/dev/null |
+      awk -v pool="$POOL" '
+        /^Tempo de execucao:/ { tempo = $4 }
+        /^Eventos:/ { eventos = $2; taxa = substr ($3, 2) }
+        /^Alocacoes:/ { aloc = $2 }
+        /^Chamadas ao malloc:/ { malloc = $4 }
+        END { printf "pool=%s tempo=%ss eventos=%s eventos/s=%s alocacoes=%s malloc=%s\n",
+                     pool, tempo, eventos, taxa, aloc, malloc }'
+  done
+done
@@ -0,0 +1,569 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MEMORIA_H
+#define MEMORIA_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/wifi-module.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <vector>
+
+#include <cstring>
+#include <execinfo.h>
+#include <link.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Contabilidade de memoria por subsistema e por no
+//
+//  So existe nos programas compilados com MEMORIA definido (ex.:
+//  redeCMemoria.cc). Sem MEMORIA as funcoes abaixo nao fazem nada e o
+//  operator new do sistema nao e tocado, entao o programa normal nao paga
+//  nada pela instrumentacao.
+//
+//  Com MEMORIA o operator new/delete global e substituido: cada bloco leva
+//  um cabecalho com o tamanho, o subsistema e o no que estavam marcados
+//  quando foi alocado. Durante a configuracao a marca vem de memoria::Marca
+//  e de memoria::PorNo (objetos criados pelos helpers). Durante
+//  Simulator::Run o no e o contexto do evento em execucao e o subsistema e
+//  o modulo do ns-3 que pediu a memoria: a pilha de chamadas e percorrida
+//  ate o primeiro endereco dentro de uma biblioteca de modulo conhecida
+//  (libns3*-wifi, -internet, -flow-monitor, -netanim, ...). Assim as filas
+//  da MAC e o estado por pacote do FlowMonitor e do NetAnim aparecem
+//  separados; buffers TCP ficam em "pilha" (modulo internet). Pacotes
+//  contam para quem os criou (aplicacao) e crescem com cabecalhos de quem
+//  os encapsula. Percorrer a pilha custa alguns microssegundos por
+//  alocacao; com o ns-3 compilado estatico nao ha bibliotecas para
+//  distinguir e tudo cai em "execucao".
+//
+//  Deve ser incluido em apenas um .cc por programa. A simulacao roda em
+//  uma unica thread, entao os contadores nao sao atomicos.
+
+namespace memoria {
+
+enum Subsistema
+{
+  OUTROS,
+  NOS,
+  PILHA,
+  P2P,
+  CSMA,
+  WIFI,
+  MOBILIDADE,
+  APLICACOES,
+  FLOWMON,
+  NETANIM,
+  EXECUCAO,
+  INSTRUMENTACAO,
+  N_SUBSISTEMAS
+};
+
+static const uint32_t SEM_NO = 0xffffffff;
+
+#ifdef MEMORIA
+
+static const char *g_nomes[N_SUBSISTEMAS] = {
+  "outros", "nos", "pilha", "p2p", "csma", "wifi", "mobilidade",
+  "aplicacoes", "flowmon", "netanim", "execucao", "instrumentacao"
+};
+
+//Nos acima do limite (e alocacoes sem no) ficam na ultima posicao
+static const uint32_t MAX_NOS = 4096;
+static const uint16_t CONTADO = 0x6d65;
+
+struct Contador
+{
+  int64_t atual;
+  int64_t pico;
+};
+
+struct Cabecalho
+{
+  uint64_t tamanho;
+  uint32_t no;
+  uint16_t subsistema;
+  uint16_t marca;
+};
+
+struct Amostra
+{
+  double tempo;
+  uint64_t rss;
+  int64_t alocado;
+  uint64_t filasWifi;
+};
+
+static bool g_ativo = false;
+static bool g_execucao = false;
+static uint16_t g_subsistema = OUTROS;
+static uint32_t g_no = SEM_NO;
+
+static Contador g_total;
+static Contador g_porSubsistema[N_SUBSISTEMAS];
+static Contador g_porNo[MAX_NOS + 1];
+static Contador g_matriz[N_SUBSISTEMAS][MAX_NOS + 1];
+
+//Faixas de codigo das bibliotecas de modulo do ns-3
+struct Faixa
+{
+  uintptr_t inicio;
+  uintptr_t fim;
+  uint16_t subsistema;
+};
+
+static const uint32_t MAX_FAIXAS = 64;
+static Faixa g_faixas[MAX_FAIXAS];
+static uint32_t g_nFaixas = 0;
+static bool g_naPilha = false;
+
+static ns3::Time g_intervalo;
+static std::vector<Amostra> *g_amostras = 0;
+
+static inline uint32_t
+Indice (uint32_t no)
+{
+  return no < MAX_NOS ? no : MAX_NOS;
+}
+
+static inline void
+Soma (Contador &c, int64_t n)
+{
+  c.atual += n;
+  if (c.atual > c.pico)
+    {
+      c.pico = c.atual;
+    }
+}
+
+static inline void
+Conta (uint16_t subsistema, uint32_t no, int64_t n)
+{
+  uint32_t i = Indice (no);
+  Soma (g_total, n);
+  Soma (g_porSubsistema[subsistema], n);
+  Soma (g_porNo[i], n);
+  Soma (g_matriz[subsistema][i], n);
+}
+
+//Subsistema do primeiro quadro da pilha que pertence a um modulo conhecido
+static inline uint16_t
+Origem (void)
+{
+  if (g_naPilha)
+    {
+      return EXECUCAO;
+    }
+  g_naPilha = true;
+  void *quadros[32];
+  int n = backtrace (quadros, 32);
+  uint16_t s = EXECUCAO;
+  for (int i = 1; i < n && s == EXECUCAO; ++i)
+    {
+      uintptr_t a = reinterpret_cast<uintptr_t> (quadros[i]);
+      for (uint32_t f = 0; f < g_nFaixas; ++f)
+        {
+          if (a >= g_faixas[f].inicio && a < g_faixas[f].fim)
+            {
+              s = g_faixas[f].subsistema;
+              break;
+            }
+        }
+    }
+  g_naPilha = false;
+  return s;
+}
+
+static int
+RegistraBiblioteca (struct dl_phdr_info *info, size_t, void *)
+{
+  //A ordem importa: internet-apps antes de internet
+  static const struct
+  {
+    const char *nome;
+    Subsistema subsistema;
+  } modulos[] = {
+    { "-flow-monitor", FLOWMON },
+    { "-netanim", NETANIM },
+    { "-wifi", WIFI },
+    { "-propagation", WIFI },
+    { "-internet-apps", APLICACOES },
+    { "-applications", APLICACOES },
+    { "-internet", PILHA },
+    { "-traffic-control", PILHA },
+    { "-csma", CSMA },
+    { "-point-to-point", P2P },
+    { "-mobility", MOBILIDADE }
+  };
+  if (!info->dlpi_name || !std::strstr (info->dlpi_name, "libns3"))
+    {
+      return 0;
+    }
+  for (uint32_t m = 0; m < sizeof (modulos) / sizeof (modulos[0]); ++m)
+    {
+      if (!std::strstr (info->dlpi_name, modulos[m].nome))
+        {
+          continue;
+        }
+      for (int h = 0; h < info->dlpi_phnum && g_nFaixas < MAX_FAIXAS; ++h)
+        {
+          const ElfW(Phdr) &ph = info->dlpi_phdr[h];
+          if (ph.p_type == PT_LOAD && (ph.p_flags & PF_X))
+            {
+              g_faixas[g_nFaixas].inicio = info->dlpi_addr + ph.p_vaddr;
+              g_faixas[g_nFaixas].fim = info->dlpi_addr + ph.p_vaddr + ph.p_memsz;
+              g_faixas[g_nFaixas].subsistema = modulos[m].subsistema;
+              g_nFaixas++;
+            }
+        }
+      break;
+    }
+  return 0;
+}
+
+static inline void *
+Aloca (std::size_t tamanho)
+{
+  Cabecalho *c = static_cast<Cabecalho *> (std::malloc (sizeof (Cabecalho) + tamanho));
+  if (!c)
+    {
+      return 0;
+    }
+  c->tamanho = tamanho;
+  c->marca = 0;
+  if (g_ativo)
+    {
+      c->subsistema = g_subsistema;
+      c->no = g_no;
+      if (g_execucao && g_subsistema == EXECUCAO)
+        {
+          c->no = ns3::Simulator::GetContext ();
+          c->subsistema = Origem ();
+        }
+      c->marca = CONTADO;
+      Conta (c->subsistema, c->no, tamanho);
+    }
+  return c + 1;
+}
+
+static inline void
+Libera (void *p)
+{
+  if (!p)
+    {
+      return;
+    }
+  Cabecalho *c = static_cast<Cabecalho *> (p) - 1;
+  if (c->marca == CONTADO)
+    {
+      Conta (c->subsistema, c->no, -int64_t (c->tamanho));
+    }
+  std::free (c);
+}
+
+//Habilita a contabilidade (alocacoes anteriores nao sao contadas)
+static inline void
+Ativa (void)
+{
+  dl_iterate_phdr (&RegistraBiblioteca, 0);
+  //A primeira chamada carrega o libgcc_s; melhor fora do operator new
+  void *quadro;
+  backtrace (&quadro, 1);
+  g_ativo = true;
+}
+
+//Marca as alocacoes seguintes com o subsistema e o no informados
+static inline void
+Marca (Subsistema subsistema, uint32_t no = SEM_NO)
+{
+  g_subsistema = subsistema;
+  g_no = no;
+}
+
+//Executa a instalacao no a no, marcando cada no com o seu id
+template <typename Instalacao>
+void
+PorNo (Subsistema subsistema, ns3::NodeContainer nos, Instalacao instalar)
+{
+  for (ns3::NodeContainer::Iterator i = nos.Begin (); i != nos.End (); ++i)
+    {
+      Marca (subsistema, (*i)->GetId ());
+      instalar (*i);
+    }
+  Marca (OUTROS);
+}
+
+//Cria os nos um a um para atribuir cada objeto Node ao proprio id
+static inline void
+CriaNos (ns3::NodeContainer &nos, uint32_t n)
+{
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      Marca (NOS, ns3::NodeList::GetNNodes ());
+      nos.Create (1);
+    }
+  Marca (OUTROS);
+}
+
+static inline uint64_t
+Rss (void)
+{
+  unsigned long total = 0, residente = 0;
+  std::FILE *f = std::fopen ("/proc/self/statm", "r");
+  if (f)
+    {
+      if (std::fscanf (f, "%lu %lu", &total, &residente) != 2)
+        {
+          residente = 0;
+        }
+      std::fclose (f);
+    }
+  return uint64_t (residente) * sysconf (_SC_PAGESIZE);
+}
+
+//Bytes nas filas da MAC Wi-Fi de um no
+static inline uint64_t
+FilasWifi (ns3::Ptr<ns3::Node> no)
+{
+  static const char *filas[] = { "Txop", "VO_Txop", "VI_Txop", "BE_Txop", "BK_Txop" };
+  uint64_t bytes = 0;
+  for (uint32_t d = 0; d < no->GetNDevices (); ++d)
+    {
+      ns3::Ptr<ns3::WifiNetDevice> dev = ns3::DynamicCast<ns3::WifiNetDevice> (no->GetDevice (d));
+      if (!dev)
+        {
+          continue;
+        }
+      for (uint32_t f = 0; f < sizeof (filas) / sizeof (filas[0]); ++f)
+        {
+          ns3::PointerValue ptr;
+          if (dev->GetMac ()->GetAttributeFailSafe (filas[f], ptr) && ptr.Get<ns3::Txop> ())
+            {
+              bytes += ptr.Get<ns3::Txop> ()->GetWifiMacQueue ()->GetNBytes ();
+            }
+        }
+    }
+  return bytes;
+}
+
+static void
+Amostrar (void)
+{
+  Marca (INSTRUMENTACAO);
+  Amostra a;
+  a.tempo = ns3::Simulator::Now ().GetSeconds ();
+  a.rss = Rss ();
+  a.alocado = g_total.atual;
+  a.filasWifi = 0;
+  for (ns3::NodeList::Iterator i = ns3::NodeList::Begin (); i != ns3::NodeList::End (); ++i)
+    {
+      a.filasWifi += FilasWifi (*i);
+    }
+  g_amostras->push_back (a);
+  ns3::Simulator::Schedule (g_intervalo, &Amostrar);
+  Marca (EXECUCAO);
+}
+
+//Passa a atribuir as alocacoes ao no de cada evento e amostra o RSS periodicamente
+static inline void
+Execucao (ns3::Time intervalo)
+{
+  if (!g_ativo)
+    {
+      return;
+    }
+  Marca (INSTRUMENTACAO);
+  g_intervalo = intervalo;
+  g_amostras = new std::vector<Amostra> ();
+  ns3::Simulator::Schedule (ns3::Seconds (0), &Amostrar);
+  g_execucao = true;
+  Marca (EXECUCAO);
+}
+
+static inline void
+Relatorio (const std::string &arquivo)
+{
+  if (!g_ativo)
+    {
+      return;
+    }
+  g_execucao = false;
+  Marca (INSTRUMENTACAO);
+  struct rusage uso;
+  getrusage (RUSAGE_SELF, &uso);
+
+  std::ofstream out (arquivo.c_str ());
+  out << "Pico de RSS: " << uso.ru_maxrss << " KiB" << std::endl;
+  out << "Pico alocado: " << g_total.pico << " bytes (atual " << g_total.atual << ")" << std::endl;
+  if (g_nFaixas == 0)
+    {
+      out << "Nenhuma biblioteca de modulo do ns-3 encontrada: a execucao nao e separada por subsistema"
+          << std::endl;
+    }
+
+  out << std::endl << "Por subsistema (bytes)" << std::endl;
+  out << "subsistema\tpico\tatual" << std::endl;
+  for (int s = 0; s < N_SUBSISTEMAS; ++s)
+    {
+      out << g_nomes[s] << "\t" << g_porSubsistema[s].pico << "\t" << g_porSubsistema[s].atual << std::endl;
+    }
+
+  out << std::endl << "Por no (bytes, pico de cada subsistema)" << std::endl;
+  out << "no\tpico\tatual";
+  for (int s = 0; s < N_SUBSISTEMAS; ++s)
+    {
+      out << "\t" << g_nomes[s];
+    }
+  out << std::endl;
+  for (uint32_t n = 0; n <= MAX_NOS; ++n)
+    {
+      if (g_porNo[n].pico == 0)
+        {
+          continue;
+        }
+      if (n == MAX_NOS)
+        {
+          out << "compartilhado";
+        }
+      else
+        {
+          out << n;
+        }
+      out << "\t" << g_porNo[n].pico << "\t" << g_porNo[n].atual;
+      for (int s = 0; s < N_SUBSISTEMAS; ++s)
+        {
+          out << "\t" << g_matriz[s][n].pico;
+        }
+      out << std::endl;
+    }
+
+  if (g_amostras)
+    {
+      out << std::endl << "Amostras" << std::endl;
+      out << "tempo\trss\talocado\tfilasWifi" << std::endl;
+      for (size_t i = 0; i < g_amostras->size (); ++i)
+        {
+          const Amostra &a = (*g_amostras)[i];
+          out << a.tempo << "\t" << a.rss << "\t" << a.alocado << "\t" << a.filasWifi << std::endl;
+        }
+    }
+  Marca (OUTROS);
+}
+
+} // namespace memoria
+
+//Blocos anteriores a memoria::Ativa tambem levam o cabecalho (marca zerada)
+void *
+operator new (std::size_t tamanho)
+{
+  void *p = memoria::Aloca (tamanho);
+  if (!p)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void *
+operator new[] (std::size_t tamanho)
+{
+  return operator new (tamanho);
+}
+
+void *
+operator new (std::size_t tamanho, const std::nothrow_t &) noexcept
+{
+  return memoria::Aloca (tamanho);
+}
+
+void *
+operator new[] (std::size_t tamanho, const std::nothrow_t &) noexcept
+{
+  return memoria::Aloca (tamanho);
+}
+
+void
+operator delete (void *p) noexcept
+{
+  memoria::Libera (p);
+}
+
+void
+operator delete[] (void *p) noexcept
+{
+  memoria::Libera (p);
+}
+
+void
+operator delete (void *p, std::size_t) noexcept
+{
+  memoria::Libera (p);
+}
+
+void
+operator delete[] (void *p, std::size_t) noexcept
+{
+  memoria::Libera (p);
+}
+
+#else /* MEMORIA */
+
+static inline void
+Ativa (void)
+{
+}
+
+static inline void
+Marca (Subsistema, uint32_t = SEM_NO)
+{
+}
+
+template <typename Instalacao>
+void
+PorNo (Subsistema, ns3::NodeContainer nos, Instalacao instalar)
+{
+  for (ns3::NodeContainer::Iterator i = nos.Begin (); i != nos.End (); ++i)
+    {
+      instalar (*i);
+    }
+}
+
+static inline void
+CriaNos (ns3::NodeContainer &nos, uint32_t n)
+{
+  nos.Create (n);
+}
+
+static inline void
+Execucao (ns3::Time)
+{
+}
+
+static inline void
+Relatorio (const std::string &)
+{
+}
+
+} // namespace memoria
+
+#endif /* MEMORIA */
+
+#endif /* MEMORIA_H */
@@ -0,0 +1,263 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include <sys/mman.h>
+
+// Pool de objetos pequenos para o caminho quente dos pacotes
+//
+//  Substitui o operator new/delete global. Com o pool ativo, blocos de ate
+//  4 KiB (Packet, Buffer::Data, cabecalhos, tags, eventos) vem de listas
+//  livres por classe de tamanho, da thread que aloca, e sao reaproveitados
+//  em vez de voltar ao malloc. As classes ficam em fatias de 64 KiB de uma
+//  regiao reservada com mmap, entao o delete descobre a classe pelo
+//  endereco, sem cabecalho por bloco. A memoria do pool nao volta ao
+//  sistema antes do fim do programa.
+//
+//  Um bloco liberado por outra thread entra na lista livre dessa thread,
+//  nao na de quem o alocou. Se essa thread terminar, os blocos da sua lista
+//  ficam perdidos ate o fim do programa. No redeD so a thread da simulacao
+//  aloca pacotes, entao isso nao acontece; cenarios com threads (tempo
+//  real, FdNetDevice) nao devem usar o pool. Cada thread conta num slot
+//  proprio (atomico, escrito so por ela) e Estatisticas soma os slots.
+//
+//  Deve ser incluido em apenas um .cc por programa, e nao junto com
+//  memoria.h (os dois substituem o operator new).
+
+namespace pool {
+
+static const std::size_t MAX_BLOCO = 4096;
+static const std::size_t FATIA = 64 * 1024;
+static const std::size_t REGIAO = std::size_t (1) << 32;
+static const std::size_t N_FATIAS = REGIAO / FATIA;
+
+//Classes de 16 em 16 bytes ate 512 e de 64 em 64 ate 4096
+static const uint32_t N_CLASSES = 32 + 56;
+
+struct Contadores
+{
+  uint64_t alocacoes;
+  uint64_t reaproveitadas;
+  uint64_t malloc;
+  uint64_t fatias;
+};
+
+struct ContadoresAtomicos
+{
+  std::atomic<uint64_t> alocacoes;
+  std::atomic<uint64_t> reaproveitadas;
+  std::atomic<uint64_t> malloc;
+  std::atomic<uint64_t> fatias;
+};
+
+static bool g_ativo = false;
+static char *g_regiao = 0;
+static std::atomic<std::size_t> g_proximaFatia (0);
+static uint8_t g_classe[N_FATIAS];
+//Um slot por thread; a partir de MAX_THREADS as threads dividem o ultimo
+static const uint32_t MAX_THREADS = 64;
+static ContadoresAtomicos g_contadores[MAX_THREADS + 1];
+static std::atomic<uint32_t> g_nThreads (0);
+static thread_local ContadoresAtomicos *g_meus = 0;
+static thread_local bool g_compartilhado = false;
+
+static thread_local void *g_livres[N_CLASSES];
+static thread_local char *g_atual[N_CLASSES];
+static thread_local char *g_fim[N_CLASSES];
+
+static inline void
+Conta (std::atomic<uint64_t> ContadoresAtomicos::*campo)
+{
+  if (!g_meus)
+    {
+      uint32_t i = g_nThreads++;
+      g_compartilhado = i >= MAX_THREADS;
+      g_meus = &g_contadores[g_compartilhado ? MAX_THREADS : i];
+    }
+  std::atomic<uint64_t> &c = g_meus->*campo;
+  if (g_compartilhado)
+    {
+      c.fetch_add (1, std::memory_order_relaxed);
+    }
+  else
+    {
+      c.store (c.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+}
+
+static inline uint32_t
+Classe (std::size_t tamanho)
+{
+  if (tamanho <= 512)
+    {
+      return tamanho ? (tamanho - 1) / 16 : 0;
+    }
+  return 32 + (tamanho - 513) / 64;
+}
+
+static inline std::size_t
+Tamanho (uint32_t classe)
+{
+  return classe < 32 ? (classe + 1) * 16 : 512 + (classe - 31) * 64;
+}
+
+static inline bool
+DoPool (void *p)
+{
+  return g_regiao && static_cast<char *> (p) >= g_regiao && static_cast<char *> (p) < g_regiao + REGIAO;
+}
+
+static inline void *
+Aloca (std::size_t tamanho)
+{
+  Conta (&ContadoresAtomicos::alocacoes);
+  if (!g_ativo || tamanho > MAX_BLOCO)
+    {
+      Conta (&ContadoresAtomicos::malloc);
+      return std::malloc (tamanho);
+    }
+  uint32_t c = Classe (tamanho);
+  void *p = g_livres[c];
+  if (p)
+    {
+      g_livres[c] = *static_cast<void **> (p);
+      Conta (&ContadoresAtomicos::reaproveitadas);
+      return p;
+    }
+  std::size_t t = Tamanho (c);
+  if (std::size_t (g_fim[c] - g_atual[c]) < t)
+    {
+      std::size_t f = g_proximaFatia++;
+      if (f >= N_FATIAS)
+        {
+          Conta (&ContadoresAtomicos::malloc);
+          return std::malloc (tamanho);
+        }
+      g_classe[f] = c;
+      g_atual[c] = g_regiao + f * FATIA;
+      g_fim[c] = g_atual[c] + FATIA;
+      Conta (&ContadoresAtomicos::fatias);
+    }
+  p = g_atual[c];
+  g_atual[c] += t;
+  return p;
+}
+
+static inline void
+Libera (void *p)
+{
+  if (!DoPool (p))
+    {
+      std::free (p);
+      return;
+    }
+  uint32_t c = g_classe[(static_cast<char *> (p) - g_regiao) / FATIA];
+  *static_cast<void **> (p) = g_livres[c];
+  g_livres[c] = p;
+}
+
+//Liga o pool; blocos alocados antes continuam sendo liberados com free
+static inline bool
+Ativa (void)
+{
+  void *r = mmap (0, REGIAO, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (r == MAP_FAILED)
+    {
+      return false;
+    }
+  g_regiao = static_cast<char *> (r);
+  g_ativo = true;
+  return true;
+}
+
+static inline Contadores
+Estatisticas (void)
+{
+  Contadores c = { 0, 0, 0, 0 };
+  for (uint32_t i = 0; i <= MAX_THREADS; ++i)
+    {
+      c.alocacoes += g_contadores[i].alocacoes.load (std::memory_order_relaxed);
+      c.reaproveitadas += g_contadores[i].reaproveitadas.load (std::memory_order_relaxed);
+      c.malloc += g_contadores[i].malloc.load (std::memory_order_relaxed);
+      c.fatias += g_contadores[i].fatias.load (std::memory_order_relaxed);
+    }
+  return c;
+}
+
+} // namespace pool
+
+void *
+operator new (std::size_t tamanho)
+{
+  void *p = pool::Aloca (tamanho);
+  if (!p)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void *
+operator new[] (std::size_t tamanho)
+{
+  return operator new (tamanho);
+}
+
+void *
+operator new (std::size_t tamanho, const std::nothrow_t &) noexcept
+{
+  return pool::Aloca (tamanho);
+}
+
+void *
+operator new[] (std::size_t tamanho, const std::nothrow_t &) noexcept
+{
+  return pool::Aloca (tamanho);
+}
+
+void
+operator delete (void *p) noexcept
+{
+  pool::Libera (p);
+}
+
+void
+operator delete[] (void *p) noexcept
+{
+  pool::Libera (p);
+}
+
+void
+operator delete (void *p, std::size_t) noexcept
+{
+  pool::Libera (p);
+}
+
+void
+operator delete[] (void *p, std::size_t) noexcept
+{
+  pool::Libera (p);
+}
+
+#endif /* POOL_H */
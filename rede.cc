@@ -21,6 +21,9 @@
 #include "ns3/applications-module.h"
 #include "ns3/netanim-module.h"
 #include "ns3/mobility-module.h"
+#include "ns3/fd-net-device-module.h"
+
+#include <chrono>
 
 using namespace ns3;
 
@@ -30,10 +33,121 @@ NS_LOG_COMPONENT_DEFINE ("redeTeste");
 * n0 ------------ n1 ------------ n2 ------------ n3
 *     5Mbps 2ms       10Mbps 1ms      1Mbps 5ms
 *     10.1.1.0         10.1.2.0         10.1.3.0
+*
+* Modo de emulacao (--emulacao=true): o simulador roda em tempo real e
+* n0/n3 ganham uma interface (FdNetDevice em modo emu, socket raw) ligada
+* a uma veth do host. A outra ponta de cada veth fica em um namespace
+* proprio, entao o kernel nao tem rota direta entre C e S e o trafego das
+* aplicacoes locais passa obrigatoriamente pelo caminho simulado.
+*
+*  netns C          host           ns-3                host        netns S
+*  vC-ns ======== vC ---- n0 ... n3 ---- vS ======== vS-ns
+*  10.1.10.2              10.1.10.1  10.1.11.1              10.1.11.2
+*
+* Preparacao do host (root). vC e vS ficam sem endereco no namespace raiz;
+* offloads desligados para o socket raw nao receber quadros maiores que a MTU:
+*
+*  ip netns add C
+*  ip link add vC type veth peer name vC-ns
+*  ip link set vC-ns netns C
+*  ip link set vC up promisc on
+*  ethtool -K vC gro off gso off tso off
+*  ip -n C link set lo up
+*  ip -n C addr add 10.1.10.2/24 dev vC-ns
+*  ip -n C link set vC-ns up
+*  ip netns exec C ethtool -K vC-ns gro off gso off tso off
+*  ip -n C route add 10.1.11.0/24 via 10.1.10.1
+*
+*  (idem para S: vS/vS-ns, 10.1.11.2/24 e rota para 10.1.10.0/24 via 10.1.11.1)
+*
+*  ./waf --run "rede --emulacao=true --dispC=vC --dispS=vS --duracao=60"
+*  ip netns exec S iperf3 -s
+*  ip netns exec C iperf3 -c 10.1.11.2
+*
+* Nao ha garantia de que o simulador acompanhe a taxa de linha: conferir a
+* vazao do iperf3 junto com o atraso maximo impresso ao fim da execucao.
 */
+
+//Verificacao periodica do atraso do simulador em relacao ao relogio real
+static std::chrono::steady_clock::time_point g_inicio;
+static Time g_atrasoMax;
+static Time g_limite;
+static uint32_t g_atrasos = 0;
+static bool g_atrasado = false;
+
+static void
+VerificaAtraso (Time intervalo)
+{
+  std::chrono::steady_clock::duration real = std::chrono::steady_clock::now () - g_inicio;
+  if (Simulator::Now ().IsZero ())
+    {
+      g_inicio = std::chrono::steady_clock::now ();
+      real = std::chrono::steady_clock::duration::zero ();
+    }
+  Time atraso = NanoSeconds (std::chrono::duration_cast<std::chrono::nanoseconds> (real).count ())
+    - Simulator::Now ();
+  if (atraso > g_atrasoMax)
+    {
+      g_atrasoMax = atraso;
+    }
+  if (atraso > g_limite)
+    {
+      g_atrasos++;
+      if (!g_atrasado)
+        {
+          std::cerr << Simulator::Now ().GetSeconds () << "s: simulador atrasado "
+                    << atraso.GetMilliSeconds () << " ms em relacao ao relogio" << std::endl;
+        }
+    }
+  else if (g_atrasado)
+    {
+      std::cerr << Simulator::Now ().GetSeconds () << "s: simulador recuperou o relogio" << std::endl;
+    }
+  g_atrasado = atraso > g_limite;
+  Simulator::Schedule (intervalo, &VerificaAtraso, intervalo);
+}
+
+//Liga o no a uma interface existente do host (ponta de uma veth)
+static NetDeviceContainer
+InstalaExterno (Ptr<Node> no, std::string disp)
+{
+  EmuFdNetDeviceHelper emu;
+  emu.SetDeviceName (disp);
+  NetDeviceContainer devices = emu.Install (no);
+  devices.Get (0)->SetAttribute ("Address", Mac48AddressValue (Mac48Address::Allocate ()));
+  return devices;
+}
+
 int
 main (int argc, char *argv[])
 {
+  bool emulacao = false;
+  std::string dispC = "vC";
+  std::string dispS = "vS";
+  double duracao = 60.0;
+  double limite = 10.0;
+  uint32_t filaRx = 10000;
+
+  CommandLine cmd;
+  cmd.AddValue ("emulacao", "Roda em tempo real ligado a dispositivos do host", emulacao);
+  cmd.AddValue ("dispC", "Interface do host (veth) ligada a n0", dispC);
+  cmd.AddValue ("dispS", "Interface do host (veth) ligada a n3", dispS);
+  cmd.AddValue ("duracao", "Duracao da emulacao (s)", duracao);
+  cmd.AddValue ("limite", "Atraso em relacao ao relogio que gera aviso (ms)", limite);
+  cmd.AddValue ("filaRx", "Pacotes lidos do host que podem aguardar o simulador", filaRx);
+  cmd.Parse (argc, argv);
+
+  if (emulacao)
+    {
+      //Tempo real e checksums reais, o trafego vem de fora do simulador
+      GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::RealtimeSimulatorImpl"));
+      GlobalValue::Bind ("ChecksumEnabled", BooleanValue (true));
+      Config::SetDefault ("ns3::RealtimeSimulatorImpl::SynchronizationMode", StringValue ("BestEffort"));
+      //O FdNetDevice le um quadro por vez (nao ha leitura em lote); a fila so
+      //absorve rajadas enquanto o simulador esta ocupado, nao aumenta a vazao
+      Config::SetDefault ("ns3::FdNetDevice::RxQueueSize", UintegerValue (filaRx));
+    }
+
   Time::SetResolution (Time::NS);
   LogComponentEnable ("UdpEchoClientApplication", LOG_LEVEL_INFO);
   LogComponentEnable ("UdpEchoServerApplication", LOG_LEVEL_INFO);
@@ -77,6 +191,18 @@ main (int argc, char *argv[])
   address.SetBase ("10.1.3.0", "255.255.255.0");
   interfaces = address.Assign (devices);
 
+  //Interfaces para o host nas pontas do caminho
+  if (emulacao)
+    {
+      devices = InstalaExterno (nodes.Get (0), dispC);
+      address.SetBase ("10.1.10.0", "255.255.255.0");
+      address.Assign (devices);
+
+      devices = InstalaExterno (nodes.Get (3), dispS);
+      address.SetBase ("10.1.11.0", "255.255.255.0");
+      address.Assign (devices);
+    }
+
   //Popula a tabela de roteamento para as redes se comunicarem
   Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
@@ -111,17 +237,34 @@ main (int argc, char *argv[])
                                  "LayoutType", StringValue ("RowFirst"));
   mobility.Install (nodes);
 
-  AnimationInterface anim ("rede.xml");
-	anim.SetConstantPosition (nodes.Get(0), 0.0, 1.0);
-  anim.SetConstantPosition (nodes.Get(1), 2.0, 3.0);
-  anim.SetConstantPosition (nodes.Get(2), 4.0, 5.0);
-  anim.SetConstantPosition (nodes.Get(3), 6.0, 7.0);
+  //Sem NetAnim e pcap na emulacao: o custo por pacote atrasaria o relogio
+  AnimationInterface *anim = 0;
+  if (!emulacao)
+    {
+      anim = new AnimationInterface ("rede.xml");
+      anim->SetConstantPosition (nodes.Get(0), 0.0, 1.0);
+      anim->SetConstantPosition (nodes.Get(1), 2.0, 3.0);
+      anim->SetConstantPosition (nodes.Get(2), 4.0, 5.0);
+      anim->SetConstantPosition (nodes.Get(3), 6.0, 7.0);
+
+      pTp1.EnablePcapAll ("rede1");
+      //pTp2.EnablePcapAll ("rede2");
+      //pTp3.EnablePcapAll ("rede3");
+    }
+  else
+    {
+      g_limite = Seconds (limite / 1000.0);
+      Simulator::Schedule (Seconds (0), &VerificaAtraso, MilliSeconds (100));
+      Simulator::Stop (Seconds (duracao));
+    }
 
-  pTp1.EnablePcapAll ("rede1");
-  //pTp2.EnablePcapAll ("rede2");
-  //pTp3.EnablePcapAll ("rede3");
-  
   Simulator::Run ();
+  if (emulacao)
+    {
+      std::cout << "Atraso maximo em relacao ao relogio: " << g_atrasoMax.GetMilliSeconds ()
+                << " ms (" << g_atrasos << " verificacoes acima de " << limite << " ms)" << std::endl;
+    }
   Simulator::Destroy ();
+  delete anim;
   return 0;
 }
\ No newline at end of file
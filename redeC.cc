@@ -24,6 +24,7 @@
 #include "ns3/internet-module.h"
 #include "ns3/netanim-module.h"
 #include "ns3/flow-monitor-module.h"
+#include "memoria.h"
 
 // Default Network Topology
 //
@@ -44,6 +45,10 @@
 //  P2P 10.1.2.0
 //  WIFI 10.1.3.0
 //
+//  --nWifi aumenta a celula Wi-Fi. O programa redeCMemoria (mesmo cenario
+//  compilado com MEMORIA) grava em memoriaRedeC.txt as alocacoes por
+//  subsistema e por no e o RSS ao longo da simulacao
+//
 
 using namespace ns3;
 
@@ -52,6 +57,16 @@ NS_LOG_COMPONENT_DEFINE ("redeC");
 int 
 main (int argc, char *argv[])
 {
+  uint32_t nWifi = 4;
+  CommandLine cmd;
+  cmd.AddValue ("nWifi", "Numero de estacoes Wi-Fi (minimo 2)", nWifi);
+  cmd.Parse (argc, argv);
+  if (nWifi < 2)
+    {
+      nWifi = 2;
+    }
+  memoria::Ativa ();
+
   LogComponentEnable ("UdpEchoClientApplication", LOG_LEVEL_INFO);
   LogComponentEnable ("UdpEchoServerApplication", LOG_LEVEL_INFO);
   LogComponentEnable ("UdpEchoClientApplication", LOG_PREFIX_NODE );
@@ -59,18 +74,19 @@ main (int argc, char *argv[])
 
   //Criando S4 e AP (conexao P2P)
   NodeContainer p2pNodes;
-  p2pNodes.Create (2);
+  memoria::CriaNos (p2pNodes, 2);
 
   PointToPointHelper pointToPoint;
   pointToPoint.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
   pointToPoint.SetChannelAttribute ("Delay", StringValue ("1ms"));
 
   NetDeviceContainer p2pDevices;
+  memoria::Marca (memoria::P2P);
   p2pDevices = pointToPoint.Install (p2pNodes);
 
   //Criando C1,C2,S3,S4 (conexao LAN)
   NodeContainer csmaNodes;
-  csmaNodes.Create (3);
+  memoria::CriaNos (csmaNodes, 3);
   csmaNodes.Add (p2pNodes.Get (0));
 
   CsmaHelper csma;
@@ -78,13 +94,15 @@ main (int argc, char *argv[])
   csma.SetChannelAttribute ("Delay", TimeValue (NanoSeconds (6560)));
 
   NetDeviceContainer csmaDevices;
+  memoria::Marca (memoria::CSMA);
   csmaDevices = csma.Install (csmaNodes);
 
   //Criando C3,C4,S1,S2 (conexao Wifi)
   NodeContainer wifiStaNodes;
-  wifiStaNodes.Create (4);
+  memoria::CriaNos (wifiStaNodes, nWifi);
   NodeContainer wifiApNode = p2pNodes.Get (1); //Colocando AP no AP
 
+  memoria::Marca (memoria::WIFI);
   YansWifiChannelHelper channel = YansWifiChannelHelper::Default ();
   YansWifiPhyHelper phy = YansWifiPhyHelper::Default ();
   phy.SetChannel (channel.Create ());
@@ -100,13 +118,17 @@ main (int argc, char *argv[])
                "ActiveProbing", BooleanValue (false));
 
   NetDeviceContainer staDevices;
-  staDevices = wifi.Install (phy, mac, wifiStaNodes);
+  memoria::PorNo (memoria::WIFI, wifiStaNodes, [&] (Ptr<Node> no) {
+    staDevices.Add (wifi.Install (phy, mac, no));
+  });
 
   mac.SetType ("ns3::ApWifiMac",
                "Ssid", SsidValue (ssid));
 
   NetDeviceContainer apDevices;
-  apDevices = wifi.Install (phy, mac, wifiApNode);
+  memoria::PorNo (memoria::WIFI, wifiApNode, [&] (Ptr<Node> no) {
+    apDevices.Add (wifi.Install (phy, mac, no));
+  });
 
   //Adicionando mobilidade
   MobilityHelper mobility;
@@ -118,20 +140,35 @@ main (int argc, char *argv[])
                                  "GridWidth", UintegerValue (2),
                                  "LayoutType", StringValue ("RowFirst"));
 
+  //A area cresce com o numero de linhas da grade (2 estacoes por linha)
+  double altura = std::max (10.0, 7.0 * ((nWifi + 1) / 2) - 5.0);
   mobility.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
-                             "Bounds", RectangleValue (Rectangle (0, 10, 0, 10)));
-  mobility.Install (wifiStaNodes);
+                             "Bounds", RectangleValue (Rectangle (0, 10, 0, altura)));
+  memoria::PorNo (memoria::MOBILIDADE, wifiStaNodes, [&] (Ptr<Node> no) {
+    mobility.Install (no);
+  });
 
   mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
-  mobility.Install (wifiApNode);
-  mobility.Install (csmaNodes);
+  memoria::PorNo (memoria::MOBILIDADE, wifiApNode, [&] (Ptr<Node> no) {
+    mobility.Install (no);
+  });
+  memoria::PorNo (memoria::MOBILIDADE, csmaNodes, [&] (Ptr<Node> no) {
+    mobility.Install (no);
+  });
 
   //Adicionando protocolos em todos os nos
   InternetStackHelper stack;
-  stack.Install (csmaNodes);
-  stack.Install (wifiApNode);
-  stack.Install (wifiStaNodes);
-
+  memoria::PorNo (memoria::PILHA, csmaNodes, [&] (Ptr<Node> no) {
+    stack.Install (no);
+  });
+  memoria::PorNo (memoria::PILHA, wifiApNode, [&] (Ptr<Node> no) {
+    stack.Install (no);
+  });
+  memoria::PorNo (memoria::PILHA, wifiStaNodes, [&] (Ptr<Node> no) {
+    stack.Install (no);
+  });
+
+  memoria::Marca (memoria::PILHA);
   Ipv4AddressHelper address;
 
   address.SetBase ("10.1.2.0", "255.255.255.0");
@@ -147,6 +184,7 @@ main (int argc, char *argv[])
   wifiInterfaces = address.Assign (staDevices);
   address.Assign (apDevices);
 
+  memoria::Marca (memoria::APLICACOES);
   UdpEchoServerHelper echoServer (9);
   //Instalando apps de servidor
   ApplicationContainer serverS1 = echoServer.Install (wifiStaNodes.Get (0));
@@ -204,6 +242,7 @@ main (int argc, char *argv[])
   clientAppsC4.Stop (Seconds (10.0));
 
   //NetAnim
+  memoria::Marca (memoria::NETANIM);
   AnimationInterface anim ("redeC.xml");
   anim.SetConstantPosition (csmaNodes.Get(0), 4.0, 15.0); //C1
   anim.SetConstantPosition (csmaNodes.Get(1), 8.0, 15.0); //C2
@@ -212,19 +251,25 @@ main (int argc, char *argv[])
 
   anim.SetConstantPosition (p2pNodes.Get(1), 10.0, 13.0); //AP
 
+  memoria::Marca (memoria::PILHA);
   Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
   //Pcap
+  memoria::Marca (memoria::P2P);
   pointToPoint.EnablePcapAll("redeC");
 
   // Flow monitor
   Ptr<FlowMonitor> flowMonitor;
   FlowMonitorHelper flowHelper;
+  memoria::Marca (memoria::FLOWMON);
   flowMonitor = flowHelper.InstallAll();
 
   Simulator::Stop (Seconds (10.0));
+  memoria::Execucao (Seconds (0.1));
   Simulator::Run ();
+  memoria::Marca (memoria::FLOWMON);
   flowMonitor->SerializeToXmlFile("flowRedeC.xml", true, true);
+  memoria::Relatorio ("memoriaRedeC.txt");
   Simulator::Destroy ();
   return 0;
 }
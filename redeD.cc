@@ -24,6 +24,9 @@
 #include "ns3/internet-module.h"
 #include "ns3/netanim-module.h"
 #include "ns3/flow-monitor-module.h"
+#include "pool.h"
+
+#include <chrono>
 
 // Default Network Topology
 //
@@ -44,6 +47,9 @@
 //  P2P 10.1.2.0
 //  WIFI 10.1.3.0
 //
+//  --pool=true aloca pacotes, buffers, cabecalhos e tags a partir de um
+//  pool reaproveitado (pool.h); benchPool.sh compara com e sem o pool
+//
 
 using namespace ns3;
 
@@ -52,6 +58,20 @@ NS_LOG_COMPONENT_DEFINE ("redeD");
 int 
 main (int argc, char *argv[])
 {
+  bool usaPool = false;
+  bool rastros = true;
+  double duracao = 10.0;
+  CommandLine cmd;
+  cmd.AddValue ("pool", "Usa o pool de objetos para pacotes e metadados", usaPool);
+  cmd.AddValue ("rastros", "Gera NetAnim e pcap", rastros);
+  cmd.AddValue ("duracao", "Fim da simulacao (s)", duracao);
+  cmd.Parse (argc, argv);
+  if (usaPool && !pool::Ativa ())
+    {
+      std::cerr << "Nao foi possivel reservar a regiao do pool" << std::endl;
+      usaPool = false;
+    }
+
   LogComponentEnable ("UdpEchoClientApplication", LOG_LEVEL_INFO);
   LogComponentEnable ("UdpEchoServerApplication", LOG_LEVEL_INFO);
 
@@ -151,77 +171,90 @@ main (int argc, char *argv[])
   clienteC1.SetAttribute ("MaxBytes", UintegerValue (0));
   ApplicationContainer c1Apps = clienteC1.Install (csmaNodes.Get (0));
   c1Apps.Start (Seconds (2.0));
-  c1Apps.Stop (Seconds (10.0));
+  c1Apps.Stop (Seconds (duracao));
 
   BulkSendHelper clienteC2 ("ns3::TcpSocketFactory",
                            InetSocketAddress (wifiInterfaces.GetAddress (1), 9));
   clienteC2.SetAttribute ("MaxBytes", UintegerValue (0));
   ApplicationContainer c2Apps = clienteC2.Install (csmaNodes.Get (1));
   c2Apps.Start (Seconds (2.0));
-  c2Apps.Stop (Seconds (10.0));
+  c2Apps.Stop (Seconds (duracao));
 
   BulkSendHelper clienteC3 ("ns3::TcpSocketFactory",
                             InetSocketAddress (csmaInterfaces.GetAddress (2), 9));
   clienteC3.SetAttribute ("MaxBytes", UintegerValue (0));
   ApplicationContainer c3Apps = clienteC3.Install (wifiStaNodes.Get (0));
   c3Apps.Start (Seconds (2.0));
-  c3Apps.Stop (Seconds (10.0));
+  c3Apps.Stop (Seconds (duracao));
 
   BulkSendHelper clienteC4 ("ns3::TcpSocketFactory",
                            InetSocketAddress (csmaInterfaces.GetAddress (3), 9));
   clienteC4.SetAttribute ("MaxBytes", UintegerValue (0));
   ApplicationContainer c4Apps = clienteC4.Install (wifiStaNodes.Get (1));
   c4Apps.Start (Seconds (2.0));
-  c4Apps.Stop (Seconds (10.0));
+  c4Apps.Stop (Seconds (duracao));
 
   //Criando aplicacoes para sink (servidores)
   PacketSinkHelper sinkS1 ("ns3::TcpSocketFactory",
                           InetSocketAddress (Ipv4Address::GetAny (), 9));
   ApplicationContainer s1Apps = sinkS1.Install (wifiStaNodes.Get (0));
   s1Apps.Start (Seconds (1.0));
-  s1Apps.Stop (Seconds (10.0));
+  s1Apps.Stop (Seconds (duracao));
 
   PacketSinkHelper sinkS2 ("ns3::TcpSocketFactory",
                           InetSocketAddress (Ipv4Address::GetAny (), 9));
   ApplicationContainer s2Apps = sinkS2.Install (wifiStaNodes.Get (1));
   s2Apps.Start (Seconds (1.0));
-  s2Apps.Stop (Seconds (10.0));
+  s2Apps.Stop (Seconds (duracao));
 
   PacketSinkHelper sinkS3 ("ns3::TcpSocketFactory",
                           InetSocketAddress (Ipv4Address::GetAny (), 9));
   ApplicationContainer s3Apps = sinkS3.Install (csmaNodes.Get (2));
   s3Apps.Start (Seconds (1.0));
-  s3Apps.Stop (Seconds (10.0));
+  s3Apps.Stop (Seconds (duracao));
 
   PacketSinkHelper sinkS4 ("ns3::TcpSocketFactory",
                           InetSocketAddress (Ipv4Address::GetAny (), 9));
   ApplicationContainer s4Apps = sinkS4.Install (csmaNodes.Get (3));
   s4Apps.Start (Seconds (1.0));
-  s4Apps.Stop (Seconds (10.0));
+  s4Apps.Stop (Seconds (duracao));
 
   //NetAnim
-  AnimationInterface anim ("redeD.xml");
-  anim.SetConstantPosition (csmaNodes.Get(0), 4.0, 15.0); //C1
-  anim.SetConstantPosition (csmaNodes.Get(1), 8.0, 15.0); //C2
-  anim.SetConstantPosition (csmaNodes.Get(2), 12.0, 15.0); //S3
-  anim.SetConstantPosition (csmaNodes.Get(3), 16.0, 15.0); //S4
-
-  anim.SetConstantPosition (p2pNodes.Get(1), 10.0, 13.0); //AP
+  AnimationInterface *anim = 0;
+  if (rastros)
+    {
+      anim = new AnimationInterface ("redeD.xml");
+      anim->SetConstantPosition (csmaNodes.Get(0), 4.0, 15.0); //C1
+      anim->SetConstantPosition (csmaNodes.Get(1), 8.0, 15.0); //C2
+      anim->SetConstantPosition (csmaNodes.Get(2), 12.0, 15.0); //S3
+      anim->SetConstantPosition (csmaNodes.Get(3), 16.0, 15.0); //S4
+
+      anim->SetConstantPosition (p2pNodes.Get(1), 10.0, 13.0); //AP
+    }
 
   Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
   //Pcap
-  pointToPoint.EnablePcapAll("redeD");
+  if (rastros)
+    {
+      pointToPoint.EnablePcapAll("redeD");
+    }
 
   // Flow monitor
   Ptr<FlowMonitor> flowMonitor;
   FlowMonitorHelper flowHelper;
   flowMonitor = flowHelper.InstallAll();
 
-  Simulator::Stop (Seconds (10.0));
+  Simulator::Stop (Seconds (duracao));
+  pool::Contadores antes = pool::Estatisticas ();
+  std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now ();
   Simulator::Run ();
+  double segundos = std::chrono::duration<double> (std::chrono::steady_clock::now () - inicio).count ();
+  pool::Contadores depois = pool::Estatisticas ();
+  uint64_t eventos = Simulator::GetEventCount ();
   flowMonitor->SerializeToXmlFile("flowRedeD.xml", true, true);
   Simulator::Destroy ();
+  delete anim;
 
   Ptr<PacketSink> sink1 = DynamicCast<PacketSink> (s1Apps.Get (0));
   Ptr<PacketSink> sink2 = DynamicCast<PacketSink> (s2Apps.Get (0));
@@ -232,5 +265,13 @@ main (int argc, char *argv[])
   std::cout << "(S3) Total Bytes Received: " << sink3->GetTotalRx () << std::endl;
   std::cout << "(S4) Total Bytes Received: " << sink4->GetTotalRx () << std::endl;
 
+  //Desempenho do Simulator::Run
+  std::cout << "Pool: " << (usaPool ? "sim" : "nao") << std::endl;
+  std::cout << "Tempo de execucao: " << segundos << " s" << std::endl;
+  std::cout << "Eventos: " << eventos << " (" << eventos / segundos << " eventos/s)" << std::endl;
+  std::cout << "Alocacoes: " << depois.alocacoes - antes.alocacoes << std::endl;
+  std::cout << "Chamadas ao malloc: " << depois.malloc - antes.malloc << std::endl;
+  std::cout << "Reaproveitadas do pool: " << depois.reaproveitadas - antes.reaproveitadas << std::endl;
+
   return 0;
 }